@@ -0,0 +1,52 @@
+#ifndef TRAININGDATA_TOOL_BOUNDEDQUEUE_H
+#define TRAININGDATA_TOOL_BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Blocking multi-producer multi-consumer FIFO with a fixed capacity. Close()
+// wakes every waiter: further pushes fail and pops drain what is left, then
+// return std::nullopt.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+    if (closed) return false;
+    items.push_back(std::move(item));
+    not_empty.notify_one();
+    return true;
+  }
+
+  std::optional<T> Pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [this] { return closed || !items.empty(); });
+    if (items.empty()) return std::nullopt;
+    std::optional<T> item{std::move(items.front())};
+    items.pop_front();
+    not_full.notify_one();
+    return item;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    not_empty.notify_all();
+    not_full.notify_all();
+  }
+
+ private:
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<T> items;
+  const size_t capacity;
+  bool closed = false;
+};
+
+#endif  // TRAININGDATA_TOOL_BOUNDEDQUEUE_H
@@ -0,0 +1,20 @@
+#include "GameArena.h"
+
+#include <cstring>
+
+GameArena::GameArena() { Reset(); }
+
+uint32_t GameArena::Store(const char* str) {
+  size_t length = std::strlen(str);
+  if (length == 0) return 0;
+  auto offset = static_cast<uint32_t>(text.size());
+  text.insert(text.end(), str, str + length + 1);
+  return offset;
+}
+
+void GameArena::Reset() {
+  text.clear();
+  // Offset 0 is the shared empty string.
+  text.push_back('\0');
+  moves.clear();
+}
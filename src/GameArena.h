@@ -0,0 +1,34 @@
+#if !defined(GAME_ARENA_H_INCLUDED)
+#define GAME_ARENA_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+#include "PGNMoveInfo.h"
+
+// Region allocator for the text and moves of a single PGN game. Strings are
+// appended to one contiguous buffer and referenced by offset, so records stay
+// valid when the buffer grows. Reset() drops the contents but keeps the
+// capacity, which makes per-game allocation essentially free once the arena
+// has seen its largest game. An arena must only be used by one thread at a
+// time.
+class GameArena {
+ public:
+  GameArena();
+
+  // Copies the null-terminated string into the arena and returns its offset.
+  // Empty strings all share offset 0.
+  uint32_t Store(const char* str);
+  const char* Get(uint32_t offset) const { return text.data() + offset; }
+
+  std::vector<PGNMoveInfo>& Moves() { return moves; }
+  const std::vector<PGNMoveInfo>& Moves() const { return moves; }
+
+  void Reset();
+
+ private:
+  std::vector<char> text;
+  std::vector<PGNMoveInfo> moves;
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "IndexedTrainingData.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kHeaderMagic[8] = {'L', 'C', '0', 'T', 'D', 'I', 'D', 'X'};
+const char kTrailerMagic[8] = {'L', 'C', '0', 'T', 'D', 'E', 'N', 'D'};
+
+IndexedBlockInfo empty_block_info() {
+  IndexedBlockInfo info{};
+  info.min_ply = ChunkInfo::kUnknownPly;
+  info.max_ply = 0;
+  return info;
+}
+
+}  // namespace
+
+IndexedSink::IndexedSink(std::string directory, size_t chunks_per_block,
+                         size_t blocks_per_file)
+    : directory(std::move(directory)),
+      chunks_per_block(chunks_per_block),
+      blocks_per_file(blocks_per_file),
+      files_written(0),
+      file(nullptr),
+      file_bytes(0),
+      block_info(empty_block_info()) {
+  if (chunks_per_block == 0 || blocks_per_file == 0) {
+    throw std::invalid_argument(
+        "Indexed files need at least one chunk per block and one block per "
+        "file");
+  }
+}
+
+IndexedSink::~IndexedSink() {
+  // Normally a no-op after TrainingDataWriter::Finalize. Errors cannot be
+  // thrown from here, so they are only reported.
+  try {
+    Flush();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    if (nullptr != file) {
+      std::fclose(file);
+    }
+  }
+}
+
+void IndexedSink::Write(const void* data, size_t length,
+                        const ChunkInfo& info) {
+  if (nullptr == file) {
+    // Every chunk format starts with its uint32 version.
+    uint32_t chunk_version;
+    std::memcpy(&chunk_version, data, sizeof(chunk_version));
+    OpenFile(chunk_version, static_cast<uint32_t>(length));
+  }
+  auto bytes = static_cast<const unsigned char*>(data);
+  block.insert(block.end(), bytes, bytes + length);
+
+  block_info.chunk_count++;
+  if (info.result > 0) {
+    block_info.wins++;
+  } else if (info.result < 0) {
+    block_info.losses++;
+  } else {
+    block_info.draws++;
+  }
+  if (info.ply != ChunkInfo::kUnknownPly) {
+    if (block_info.min_ply == ChunkInfo::kUnknownPly) {
+      block_info.min_ply = block_info.max_ply = info.ply;
+    } else {
+      block_info.min_ply = std::min(block_info.min_ply, info.ply);
+      block_info.max_ply = std::max(block_info.max_ply, info.ply);
+    }
+  }
+
+  if (block_info.chunk_count >= chunks_per_block) {
+    WriteBlock();
+  }
+}
+
+void IndexedSink::Flush() {
+  // The short block is the last one of its file, so readers can still locate
+  // chunks by division.
+  if (block_info.chunk_count > 0) {
+    WriteBlock();
+  }
+  CloseFile();
+}
+
+void IndexedSink::OpenFile(uint32_t chunk_version, uint32_t chunk_size) {
+  std::filesystem::create_directories(directory);
+  std::ostringstream oss;
+  oss << directory << "/chunks_" << std::setfill('0') << std::setw(6)
+      << files_written << kIndexedFileExtension;
+  filename = oss.str();
+  file = std::fopen(filename.c_str(), "wb");
+  if (nullptr == file) {
+    throw std::runtime_error("Cannot create file " + filename);
+  }
+  IndexedFileHeader header{};
+  std::memcpy(header.magic, kHeaderMagic, sizeof(header.magic));
+  header.chunk_version = chunk_version;
+  header.chunk_size = chunk_size;
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    throw std::runtime_error("Unable to write into " + filename);
+  }
+  file_bytes = sizeof(header);
+  index.clear();
+}
+
+void IndexedSink::WriteBlock() {
+  uLongf compressed_size = compressBound(static_cast<uLong>(block.size()));
+  compressed.resize(compressed_size);
+  if (compress(compressed.data(), &compressed_size, block.data(),
+               static_cast<uLong>(block.size())) != Z_OK) {
+    throw std::runtime_error("Unable to compress block for " + filename);
+  }
+  if (std::fwrite(compressed.data(), 1, compressed_size, file) !=
+      compressed_size) {
+    throw std::runtime_error("Unable to write into " + filename);
+  }
+  block_info.offset = file_bytes;
+  block_info.compressed_size = static_cast<uint32_t>(compressed_size);
+  if (block_info.min_ply == ChunkInfo::kUnknownPly) {
+    block_info.max_ply = ChunkInfo::kUnknownPly;
+  }
+  index.push_back(block_info);
+  file_bytes += compressed_size;
+
+  block.clear();
+  block_info = empty_block_info();
+  if (index.size() >= blocks_per_file) {
+    CloseFile();
+  }
+}
+
+void IndexedSink::CloseFile() {
+  if (nullptr == file) return;
+  IndexedFileTrailer trailer{};
+  trailer.index_offset = file_bytes;
+  trailer.block_count = static_cast<uint32_t>(index.size());
+  trailer.chunks_per_block = static_cast<uint32_t>(chunks_per_block);
+  std::memcpy(trailer.magic, kTrailerMagic, sizeof(trailer.magic));
+  bool ok = std::fwrite(index.data(), sizeof(IndexedBlockInfo), index.size(),
+                        file) == index.size() &&
+            std::fwrite(&trailer, sizeof(trailer), 1, file) == 1;
+  ok = std::fclose(file) == 0 && ok;
+  file = nullptr;
+  files_written++;
+  if (!ok) {
+    throw std::runtime_error("Unable to write index of " + filename);
+  }
+}
+
+template <typename Format>
+IndexedTrainingDataReader<Format>::IndexedTrainingDataReader(
+    const std::string& filename)
+    : filename(filename), num_chunks(0) {
+#ifdef _WIN32
+  file = std::fopen(filename.c_str(), "rb");
+  if (nullptr == file) {
+#else
+  fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+#endif
+    throw std::runtime_error("Cannot open " + filename);
+  }
+
+  // The destructor does not run when the constructor throws.
+  try {
+    ReadIndex();
+  } catch (...) {
+    Close();
+    throw;
+  }
+}
+
+template <typename Format>
+IndexedTrainingDataReader<Format>::~IndexedTrainingDataReader() {
+  Close();
+}
+
+template <typename Format>
+void IndexedTrainingDataReader<Format>::Close() {
+#ifdef _WIN32
+  std::fclose(file);
+#else
+  close(fd);
+#endif
+}
+
+template <typename Format>
+void IndexedTrainingDataReader<Format>::ReadIndex() {
+  IndexedFileHeader header;
+  ReadAt(0, &header, sizeof(header));
+  if (std::memcmp(header.magic, kHeaderMagic, sizeof(header.magic)) != 0) {
+    throw std::runtime_error(filename + " is not an indexed training file");
+  }
+  if (header.chunk_version != Format::kVersion ||
+      header.chunk_size != sizeof(Chunk)) {
+    throw std::runtime_error(filename + " holds V" +
+                             std::to_string(header.chunk_version) +
+                             " training data, expected V" +
+                             std::to_string(Format::kVersion));
+  }
+
+  // The trailer sits at the very end; find it from the file size.
+#ifdef _WIN32
+  _fseeki64(file, 0, SEEK_END);
+  uint64_t file_size = _ftelli64(file);
+#else
+  uint64_t file_size = lseek(fd, 0, SEEK_END);
+#endif
+  IndexedFileTrailer trailer;
+  if (file_size < sizeof(header) + sizeof(trailer)) {
+    throw std::runtime_error(filename + " is truncated");
+  }
+  ReadAt(file_size - sizeof(trailer), &trailer, sizeof(trailer));
+  if (std::memcmp(trailer.magic, kTrailerMagic, sizeof(trailer.magic)) != 0) {
+    throw std::runtime_error(filename + " is truncated");
+  }
+  // The index runs from index_offset right up to the trailer.
+  uint64_t index_end = file_size - sizeof(trailer);
+  if (trailer.chunks_per_block == 0 || trailer.index_offset < sizeof(header) ||
+      trailer.index_offset > index_end ||
+      index_end - trailer.index_offset !=
+          uint64_t{trailer.block_count} * sizeof(IndexedBlockInfo)) {
+    throw std::runtime_error(filename + " has a corrupt trailer");
+  }
+  chunks_per_block = trailer.chunks_per_block;
+  index.resize(trailer.block_count);
+  ReadAt(trailer.index_offset, index.data(),
+         index.size() * sizeof(IndexedBlockInfo));
+  for (size_t block = 0; block < index.size(); ++block) {
+    const IndexedBlockInfo& info = index[block];
+    // ReadChunk locates chunks by division, so only the last block may be
+    // short.
+    bool last = block + 1 == index.size();
+    if (info.offset < sizeof(header) || info.offset > trailer.index_offset ||
+        trailer.index_offset - info.offset < info.compressed_size ||
+        info.chunk_count == 0 || info.chunk_count > chunks_per_block ||
+        (!last && info.chunk_count != chunks_per_block)) {
+      throw std::runtime_error("Corrupt index entry " + std::to_string(block) +
+                               " in " + filename);
+    }
+    num_chunks += info.chunk_count;
+  }
+}
+
+template <typename Format>
+std::vector<typename Format::Chunk>
+IndexedTrainingDataReader<Format>::ReadBlock(size_t block) const {
+  std::vector<Chunk> chunks(index[block].chunk_count);
+  Inflate(block, chunks.size(), chunks.data());
+  return chunks;
+}
+
+template <typename Format>
+typename Format::Chunk IndexedTrainingDataReader<Format>::ReadChunk(
+    size_t chunk_index) const {
+  if (chunk_index >= num_chunks) {
+    throw std::out_of_range("Chunk " + std::to_string(chunk_index) +
+                            " is past the end of " + filename);
+  }
+  size_t position = chunk_index % chunks_per_block;
+  std::vector<Chunk> chunks(position + 1);
+  Inflate(chunk_index / chunks_per_block, chunks.size(), chunks.data());
+  return chunks.back();
+}
+
+template <typename Format>
+void IndexedTrainingDataReader<Format>::ReadAt(uint64_t offset, void* buffer,
+                                               size_t length) const {
+#ifdef _WIN32
+  std::lock_guard<std::mutex> lock(file_mutex);
+  bool ok = _fseeki64(file, offset, SEEK_SET) == 0 &&
+            std::fread(buffer, 1, length, file) == length;
+#else
+  bool ok = pread(fd, buffer, length, offset) == static_cast<ssize_t>(length);
+#endif
+  if (!ok) {
+    throw std::runtime_error("Unable to read from " + filename);
+  }
+}
+
+template <typename Format>
+void IndexedTrainingDataReader<Format>::Inflate(size_t block,
+                                                size_t chunk_count,
+                                                Chunk* out) const {
+  const IndexedBlockInfo& info = index[block];
+  std::vector<unsigned char> compressed(info.compressed_size);
+  ReadAt(info.offset, compressed.data(), compressed.size());
+
+  z_stream stream{};
+  if (inflateInit(&stream) != Z_OK) {
+    throw std::runtime_error("Cannot initialize inflate for " + filename);
+  }
+  stream.next_in = compressed.data();
+  stream.avail_in = static_cast<uInt>(compressed.size());
+  stream.next_out = reinterpret_cast<Bytef*>(out);
+  stream.avail_out = static_cast<uInt>(chunk_count * sizeof(Chunk));
+  // Stops as soon as the output is full, so leading chunks cost less.
+  int ret = inflate(&stream, Z_SYNC_FLUSH);
+  bool ok = stream.avail_out == 0 && (ret == Z_OK || ret == Z_STREAM_END);
+  inflateEnd(&stream);
+  if (!ok) {
+    throw std::runtime_error("Corrupt block " + std::to_string(block) +
+                             " in " + filename);
+  }
+}
+
+template class IndexedTrainingDataReader<V4Format>;
+template class IndexedTrainingDataReader<V5Format>;
+template class IndexedTrainingDataReader<V6Format>;
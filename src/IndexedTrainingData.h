@@ -0,0 +1,133 @@
+#ifndef TRAININGDATA_TOOL_INDEXEDTRAININGDATA_H
+#define TRAININGDATA_TOOL_INDEXEDTRAININGDATA_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TrainingDataFormat.h"
+#include "TrainingDataSink.h"
+
+// Seekable container for training data, stored in .tdi files:
+//
+//   IndexedFileHeader
+//   block 0 ... block N-1   zlib streams of chunks_per_block chunks each,
+//                           except the last which may hold fewer
+//   IndexedBlockInfo[N]
+//   IndexedFileTrailer
+//
+// The footer index gives the offset and metadata of every block, so a reader
+// finds any chunk or block in O(1) and inflates only that block.
+constexpr const char* kIndexedFileExtension = ".tdi";
+
+#pragma pack(push, 1)
+struct IndexedFileHeader {
+  char magic[8];
+  // Version field of the stored chunks, as in V4TrainingData::version.
+  uint32_t chunk_version;
+  uint32_t chunk_size;
+};
+
+struct IndexedBlockInfo {
+  uint64_t offset;
+  uint32_t compressed_size;
+  uint32_t chunk_count;
+  // Results from the side to move's perspective.
+  uint32_t wins;
+  uint32_t draws;
+  uint32_t losses;
+  // Game ply range, ChunkInfo::kUnknownPly when no chunk had a known ply.
+  uint16_t min_ply;
+  uint16_t max_ply;
+};
+
+struct IndexedFileTrailer {
+  uint64_t index_offset;
+  uint32_t block_count;
+  uint32_t chunks_per_block;
+  char magic[8];
+};
+#pragma pack(pop)
+
+// Writes <directory>/chunks_NNNNNN.tdi files of up to blocks_per_file blocks.
+// Logical file boundaries from the writer are ignored and blocks are filled
+// up. Flush() writes the pending partial block and the index, closing the
+// current file, so only the last block of a file can be short; later chunks
+// go to a new file.
+class IndexedSink : public TrainingDataSink {
+ public:
+  IndexedSink(std::string directory, size_t chunks_per_block,
+              size_t blocks_per_file);
+  ~IndexedSink() override;
+
+  void BeginFile(size_t) override {}
+  void Write(const void* data, size_t length, const ChunkInfo& info) override;
+  void EndFile() override {}
+  void Flush() override;
+
+ private:
+  void OpenFile(uint32_t chunk_version, uint32_t chunk_size);
+  void WriteBlock();
+  void CloseFile();
+
+  const std::string directory;
+  const size_t chunks_per_block;
+  const size_t blocks_per_file;
+  size_t files_written;
+  std::string filename;
+  FILE* file;
+  uint64_t file_bytes;
+  std::vector<IndexedBlockInfo> index;
+  IndexedBlockInfo block_info;
+  std::vector<unsigned char> block;
+  std::vector<unsigned char> compressed;
+};
+
+// Random access reader for one .tdi file. Reads use pread where available,
+// so ReadBlock and ReadChunk may be called from several threads at once.
+// Instantiated for V4Format, V5Format and V6Format.
+template <typename Format>
+class IndexedTrainingDataReader {
+ public:
+  using Chunk = typename Format::Chunk;
+
+  explicit IndexedTrainingDataReader(const std::string& filename);
+  ~IndexedTrainingDataReader();
+
+  IndexedTrainingDataReader(const IndexedTrainingDataReader&) = delete;
+  IndexedTrainingDataReader& operator=(const IndexedTrainingDataReader&) =
+      delete;
+
+  size_t NumChunks() const { return num_chunks; }
+  size_t NumBlocks() const { return index.size(); }
+  const IndexedBlockInfo& BlockInfo(size_t block) const {
+    return index[block];
+  }
+
+  std::vector<Chunk> ReadBlock(size_t block) const;
+  // Inflates the containing block only up to the requested chunk.
+  Chunk ReadChunk(size_t chunk_index) const;
+
+ private:
+  // Reads and validates the header, trailer and block index.
+  void ReadIndex();
+  void Close();
+  void ReadAt(uint64_t offset, void* buffer, size_t length) const;
+  // Inflates the first chunk_count chunks of block into out.
+  void Inflate(size_t block, size_t chunk_count, Chunk* out) const;
+
+  const std::string filename;
+#ifdef _WIN32
+  FILE* file;
+  mutable std::mutex file_mutex;
+#else
+  int fd;
+#endif
+  uint32_t chunks_per_block;
+  size_t num_chunks;
+  std::vector<IndexedBlockInfo> index;
+};
+
+#endif  // TRAININGDATA_TOOL_INDEXEDTRAININGDATA_H
@@ -57,21 +57,29 @@ lczero::Move poly_move_to_lc0_move(move_t move, board_t* board) {
   return m;
 }
 
-PGNGame::PGNGame(pgn_t* pgn) {
-  strncpy(this->result, pgn->result, PGN_STRING_SIZE);
-  strncpy(this->fen, pgn->fen, PGN_STRING_SIZE);
+PGNGame::PGNGame(pgn_t* pgn, GameArena& arena) : arena(arena) {
+  arena.Reset();
+  this->result = arena.Store(pgn->result);
+  this->fen = arena.Store(pgn->fen);
 
   char str[256];
   while (pgn_next_move(pgn, str, 256)) {
-    this->moves.emplace_back(str, pgn->last_read_comment, pgn->last_read_nag);
+    arena.Moves().push_back({arena.Store(str),
+                             arena.Store(pgn->last_read_comment),
+                             arena.Store(pgn->last_read_nag)});
   }
 }
 
-std::vector<lczero::V4TrainingData> PGNGame::getChunks(Options options) const {
-  std::vector<lczero::V4TrainingData> chunks;
+template <typename Format>
+std::vector<typename Format::Chunk> PGNGame::getChunks(
+    Options options, std::vector<uint16_t>* plies) const {
+  std::vector<typename Format::Chunk> chunks;
+  chunks.reserve(arena.Moves().size());
   lczero::ChessBoard starting_board;
+  const char* pgn_fen = arena.Get(this->fen);
+  const char* pgn_result = arena.Get(this->result);
   std::string starting_fen =
-      std::strlen(this->fen) > 0 ? this->fen : lczero::ChessBoard::kStartposFen;
+      std::strlen(pgn_fen) > 0 ? pgn_fen : lczero::ChessBoard::kStartposFen;
 
   {
     std::istringstream fen_str(starting_fen);
@@ -99,40 +107,46 @@ std::vector<lczero::V4TrainingData> PGNGame::getChunks(Options options) const {
 
   lczero::GameResult game_result;
   if (options.verbose) {
-    std::cout << "Game result: " << this->result << std::endl;
+    std::cout << "Game result: " << pgn_result << std::endl;
   }
-  if (my_string_equal(this->result, "1-0")) {
+  if (my_string_equal(pgn_result, "1-0")) {
     game_result = lczero::GameResult::WHITE_WON;
-  } else if (my_string_equal(this->result, "0-1")) {
+  } else if (my_string_equal(pgn_result, "0-1")) {
     game_result = lczero::GameResult::BLACK_WON;
   } else {
     game_result = lczero::GameResult::DRAW;
   }
 
   char str[256];
-  for (auto pgn_move : this->moves) {
+  const int total_plies = static_cast<int>(arena.Moves().size());
+  int ply = 0;
+  PositionSampler sampler(options.sampling, this->index, total_plies);
+  for (const auto& pgn_move : arena.Moves()) {
+    const char* san = arena.Get(pgn_move.move);
+    const char* comment = arena.Get(pgn_move.comment);
+    const char* nag = arena.Get(pgn_move.nag);
+
     // Extract move from pgn
-    int move = move_from_san(pgn_move.move, board);
+    int move = move_from_san(san, board);
     if (move == MoveNone || !move_is_legal(move, board)) {
-      std::cout << "illegal move \"" << pgn_move.move << std::endl;
+      std::cout << "illegal move \"" << san << std::endl;
       break;
     }
 
     if (options.verbose) {
       move_to_san(move, board, str, 256);
       std::cout << "Read move: " << str << std::endl;
-      if (pgn_move.comment[0]) {
-        std::cout << str << " pgn comment: " << pgn_move.comment << std::endl;
+      if (comment[0]) {
+        std::cout << str << " pgn comment: " << comment << std::endl;
       }
     }
 
     bool bad_move = false;
-    if (pgn_move.nag[0]) {
+    if (nag[0]) {
       // If the move is bad or dubious, skip it.
       // See https://en.wikipedia.org/wiki/Numeric_Annotation_Glyphs for PGN
       // NAGs
-      if (pgn_move.nag[0] == '2' || pgn_move.nag[0] == '4' ||
-          pgn_move.nag[0] == '5' || pgn_move.nag[0] == '6') {
+      if (nag[0] == '2' || nag[0] == '4' || nag[0] == '5' || nag[0] == '6') {
         bad_move = true;
       }
     }
@@ -149,17 +163,16 @@ std::vector<lczero::V4TrainingData> PGNGame::getChunks(Options options) const {
       }
     }
     if (!found) {
-      std::cout << "Move not found: " << pgn_move.move << " "
+      std::cout << "Move not found: " << san << " "
                 << square_file(move_to(move)) << std::endl;
     }
 
     // Extract SF scores and convert to win probability
     float Q = 0.0f;
     if (options.lichess_mode) {
-      if (pgn_move.comment[0]) {
+      if (comment[0]) {
         float lichess_score;
-        bool success =
-            extract_lichess_comment_score(pgn_move.comment, lichess_score);
+        bool success = extract_lichess_comment_score(comment, lichess_score);
         if (!success) {
           break;  // Comment contained no "%eval"
         }
@@ -170,11 +183,19 @@ std::vector<lczero::V4TrainingData> PGNGame::getChunks(Options options) const {
       }
     }
 
-    if (!(bad_move && options.lichess_mode)) {
+    // Sample before encoding, so dropped positions cost nothing more.
+    uint64_t position_hash = 0;
+    if (sampler.NeedsPositionHash()) {
+      position_hash = position_history.Last().GetBoard().Hash();
+    }
+    bool keep = sampler.Keep(ply, position_hash);
+
+    if (!(bad_move && options.lichess_mode) && keep) {
       // Generate training data
-      lczero::V4TrainingData chunk = get_v4_training_data(
-          game_result, position_history, lc0_move, legal_moves, Q);
-      chunks.push_back(chunk);
+      chunks.push_back(get_training_data<Format>(game_result, position_history,
+                                                 lc0_move, legal_moves, Q,
+                                                 total_plies - ply));
+      if (plies) plies->push_back(static_cast<uint16_t>(ply));
       if (options.verbose) {
         std::string result;
         switch (game_result) {
@@ -199,6 +220,7 @@ std::vector<lczero::V4TrainingData> PGNGame::getChunks(Options options) const {
     // Execute move
     position_history.Append(lc0_move);
     move_do(board, move);
+    ply++;
   }
 
   if (options.verbose) {
@@ -207,3 +229,10 @@ std::vector<lczero::V4TrainingData> PGNGame::getChunks(Options options) const {
 
   return chunks;
 }
+
+template std::vector<V4Format::Chunk> PGNGame::getChunks<V4Format>(
+    Options options, std::vector<uint16_t>* plies) const;
+template std::vector<V5Format::Chunk> PGNGame::getChunks<V5Format>(
+    Options options, std::vector<uint16_t>* plies) const;
+template std::vector<V6Format::Chunk> PGNGame::getChunks<V6Format>(
+    Options options, std::vector<uint16_t>* plies) const;
@@ -6,22 +6,31 @@
 #include "neural/writer.h"
 #include "pgn.h"
 #include "polyglot_lib.h"
-#include "PGNMoveInfo.h"
-
-class PGNMoveInfo;
+#include "GameArena.h"
+#include "PositionSampler.h"
+#include "TrainingDataFormat.h"
 
 struct Options {
   bool verbose = false;
   bool lichess_mode = false;
+  SamplingOptions sampling;
 };
 
+// View of a single game whose text and moves live in a GameArena. Reading a
+// game resets the arena, so a PGNGame is only valid until the next game is
+// read into the same arena.
 struct PGNGame {
-  char result[PGN_STRING_SIZE];
-  char fen[PGN_STRING_SIZE];
-  std::vector<PGNMoveInfo> moves;
+  GameArena& arena;
+  uint32_t result;
+  uint32_t fen;
+  // Position of the game in the input, the sampling key.
+  int64_t index = 0;
 
-  explicit PGNGame(pgn_t* pgn);
-  std::vector<lczero::V4TrainingData> getChunks(Options options) const;
+  explicit PGNGame(pgn_t* pgn, GameArena& arena);
+  // If plies is given, the game ply of each returned chunk is appended to it.
+  template <typename Format>
+  std::vector<typename Format::Chunk> getChunks(
+      Options options, std::vector<uint16_t>* plies = nullptr) const;
 };
 
 #endif
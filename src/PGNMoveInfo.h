@@ -1,13 +1,15 @@
 #if !defined(PGN_MOVE_INFO_H_INCLUDED)
 #define PGN_MOVE_INFO_H_INCLUDED
 
-#include "pgn.h"
+#include <cstdint>
 
+// Compact move record. Each field is an offset into the owning GameArena's
+// text buffer, so a ply costs 12 bytes instead of three PGN_STRING_SIZE
+// arrays.
 struct PGNMoveInfo {
-  char move[PGN_STRING_SIZE];
-  char comment[PGN_STRING_SIZE];
-  char nag[PGN_STRING_SIZE];
-  explicit PGNMoveInfo(char* move, char* comment, char* nag);
+  uint32_t move;
+  uint32_t comment;
+  uint32_t nag;
 };
 
 #endif
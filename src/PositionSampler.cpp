@@ -0,0 +1,43 @@
+#include "PositionSampler.h"
+
+#include <algorithm>
+
+namespace {
+
+// splitmix64 finalizer.
+uint64_t mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+PositionSampler::PositionSampler(const SamplingOptions& options,
+                                 int64_t game_index, int game_plies)
+    : options(options), game_index(game_index), keep_rate(options.keep_rate) {
+  if (options.target_per_game > 0) {
+    keep_rate = std::min(1.0f, static_cast<float>(options.target_per_game) /
+                                   std::max(1, game_plies));
+  }
+  keeps_everything =
+      keep_rate >= 1.0f &&
+      (options.opening_plies <= 0 || options.opening_keep_rate >= 1.0f);
+}
+
+bool PositionSampler::Keep(int ply, uint64_t position_hash) const {
+  if (keeps_everything) return true;
+  float rate =
+      ply < options.opening_plies ? options.opening_keep_rate : keep_rate;
+  if (rate >= 1.0f) return true;
+  if (rate <= 0.0f) return false;
+
+  uint64_t key = options.by_position
+                     ? mix(position_hash)
+                     : mix(mix(static_cast<uint64_t>(game_index)) + ply);
+  uint64_t hash = mix(options.seed ^ key);
+  // Top 53 bits as a uniform double in [0, 1).
+  double uniform = static_cast<double>(hash >> 11) * (1.0 / (1ull << 53));
+  return uniform < rate;
+}
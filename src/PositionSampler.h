@@ -0,0 +1,46 @@
+#if !defined(POSITION_SAMPLER_H_INCLUDED)
+#define POSITION_SAMPLER_H_INCLUDED
+
+#include <cstdint>
+
+// Down-sampling of positions at conversion time. Every decision is a pure
+// function of the seed and a key, so the same input and options always keep
+// the same positions, whatever the number of threads.
+//
+// A position at ply p is kept with probability opening_keep_rate when
+// p < opening_plies and keep_rate otherwise. If target_per_game is set it
+// replaces keep_rate with target_per_game / <plies in the game>, capped at 1.
+//
+// The key is (game index, ply) by default. With by_position it is the board
+// hash instead, so a position reached in many games is kept in all of them or
+// in none, which also thins out common openings.
+struct SamplingOptions {
+  uint64_t seed = 0;
+  float keep_rate = 1.0f;
+  int opening_plies = 0;
+  float opening_keep_rate = 1.0f;
+  int target_per_game = 0;
+  bool by_position = false;
+};
+
+class PositionSampler {
+ public:
+  PositionSampler(const SamplingOptions& options, int64_t game_index,
+                  int game_plies);
+
+  // Whether the position at ply should be encoded. position_hash is only
+  // used with by_position.
+  bool Keep(int ply, uint64_t position_hash) const;
+
+  bool NeedsPositionHash() const {
+    return options.by_position && !keeps_everything;
+  }
+
+ private:
+  const SamplingOptions options;
+  const int64_t game_index;
+  float keep_rate;
+  bool keeps_everything;
+};
+
+#endif
@@ -1,6 +1,6 @@
 #include "TrainingDataDedup.h"
 
-#include "V4TrainingDataHashUtil.h"
+#include "TrainingDataHashUtil.h"
 
 #include <iostream>
 #include <unordered_map>
@@ -9,8 +9,8 @@ float merge_val(float old_val, size_t old_count, float new_val) {
   return (old_val * old_count + new_val) / static_cast<float>(old_count + 1);
 }
 
-void merge_chunks(lczero::V4TrainingData& chunk, size_t old_count,
-                  const lczero::V4TrainingData& new_chunk) {
+template <typename Chunk>
+void merge_chunks(Chunk& chunk, size_t old_count, const Chunk& new_chunk) {
   for (size_t i = 0; i < ARR_LENGTH(chunk.probabilities); ++i) {
     chunk.probabilities[i] = merge_val(chunk.probabilities[i], old_count,
                                        new_chunk.probabilities[i]);
@@ -22,8 +22,8 @@ void merge_chunks(lczero::V4TrainingData& chunk, size_t old_count,
   chunk.root_d = merge_val(chunk.root_d, old_count, new_chunk.root_d);
 }
 
-void flush(TrainingDataWriter& writer,
-           std::unordered_map<lczero::V4TrainingData, size_t>& chunk_map,
+template <typename Format>
+void flush(TrainingDataWriter<Format>& writer, ChunkCountMap<Format>& chunk_map,
            size_t& unique_count, size_t& total_count) {
   std::cout << "Start writing chunks..." << std::endl;
   writer.EnqueueChunks(chunk_map);
@@ -39,18 +39,20 @@ void flush(TrainingDataWriter& writer,
   total_count = 0;
 }
 
-void training_data_dedup(TrainingDataReader& reader, TrainingDataWriter& writer,
+template <typename Format>
+void training_data_dedup(TrainingDataReader<Format>& reader,
+                         TrainingDataWriter<Format>& writer,
                          const size_t dedup_uniq_buffersize,
                          const float q_ratio) {
   size_t unique_count = 0;
   size_t total_count = 0;
-  std::unordered_map<lczero::V4TrainingData, size_t> chunk_map;
+  ChunkCountMap<Format> chunk_map;
 
   while (auto new_chunk = reader.ReadChunk()) {
     total_count++;
 
     // Average Z and Q depending on q_ratio
-    auto Z = static_cast<float>(new_chunk->result);
+    float Z = Format::GetResult(*new_chunk);
     new_chunk->best_q = new_chunk->best_q * q_ratio + Z * (1.0f - q_ratio);
     new_chunk->root_q = new_chunk->root_q * q_ratio + Z * (1.0f - q_ratio);
 
@@ -59,7 +61,7 @@ void training_data_dedup(TrainingDataReader& reader, TrainingDataWriter& writer,
       chunk_map.emplace(*new_chunk, 1);
       unique_count++;
     } else {
-      lczero::V4TrainingData merged = elem->first;
+      typename Format::Chunk merged = elem->first;
       size_t old_count = elem->second;
       merge_chunks(merged, elem->second, *new_chunk);
       chunk_map.erase(elem);
@@ -71,3 +73,13 @@ void training_data_dedup(TrainingDataReader& reader, TrainingDataWriter& writer,
   }
   flush(writer, chunk_map, unique_count, total_count);
 }
+
+template void training_data_dedup<V4Format>(TrainingDataReader<V4Format>&,
+                                            TrainingDataWriter<V4Format>&,
+                                            const size_t, const float);
+template void training_data_dedup<V5Format>(TrainingDataReader<V5Format>&,
+                                            TrainingDataWriter<V5Format>&,
+                                            const size_t, const float);
+template void training_data_dedup<V6Format>(TrainingDataReader<V6Format>&,
+                                            TrainingDataWriter<V6Format>&,
+                                            const size_t, const float);
@@ -4,7 +4,9 @@
 #include "TrainingDataReader.h"
 #include "TrainingDataWriter.h"
 
-void training_data_dedup(TrainingDataReader& reader, TrainingDataWriter& writer,
+template <typename Format>
+void training_data_dedup(TrainingDataReader<Format>& reader,
+                         TrainingDataWriter<Format>& writer,
                          const size_t dedup_uniq_buffersize,
                          const float q_ratio);
 
@@ -0,0 +1,103 @@
+#ifndef TRAININGDATA_TOOL_TRAININGDATAFORMAT_H
+#define TRAININGDATA_TOOL_TRAININGDATAFORMAT_H
+
+#include <cstdint>
+
+#include "neural/writer.h"
+
+// The lc0 submodule only ships the V4 layout, so the newer records are
+// declared here. Layouts match lc0's src/trainingdata/trainingdata.h.
+#pragma pack(push, 1)
+struct V5TrainingData {
+  uint32_t version;
+  uint32_t input_format;
+  float probabilities[1858];
+  uint64_t planes[104];
+  uint8_t castling_us_ooo;
+  uint8_t castling_us_oo;
+  uint8_t castling_them_ooo;
+  uint8_t castling_them_oo;
+  uint8_t side_to_move_or_enpassant;
+  uint8_t rule50_count;
+  uint8_t invariance_info;
+  int8_t result;
+  float root_q;
+  float best_q;
+  float root_d;
+  float best_d;
+  float root_m;
+  float best_m;
+  float plies_left;
+};
+
+struct V6TrainingData {
+  uint32_t version;
+  uint32_t input_format;
+  float probabilities[1858];
+  uint64_t planes[104];
+  uint8_t castling_us_ooo;
+  uint8_t castling_us_oo;
+  uint8_t castling_them_ooo;
+  uint8_t castling_them_oo;
+  uint8_t side_to_move_or_enpassant;
+  uint8_t rule50_count;
+  uint8_t invariance_info;
+  uint8_t dummy;
+  float root_q;
+  float best_q;
+  float root_d;
+  float best_d;
+  float root_m;
+  float best_m;
+  float plies_left;
+  float result_q;
+  float result_d;
+  float played_q;
+  float played_d;
+  float played_m;
+  float orig_q;
+  float orig_d;
+  float orig_m;
+  uint32_t visits;
+  uint16_t played_idx;
+  uint16_t best_idx;
+  float policy_kld;
+  uint32_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(V5TrainingData) == 8308, "Unexpected V5 record size");
+static_assert(sizeof(V6TrainingData) == 8356, "Unexpected V6 record size");
+
+// Format traits. Encoder, reader, writer and dedup are templated on these so
+// every format gets its own hot path with no runtime version checks.
+//
+//  Chunk        - on-disk record type.
+//  kVersion     - value of the record's version field.
+//  kSideToMove  - member holding the side to move.
+//  GetResult()  - game result from the side to move's perspective, in [-1, 1].
+struct V4Format {
+  using Chunk = lczero::V4TrainingData;
+  static constexpr uint32_t kVersion = 4;
+  static constexpr auto kSideToMove = &Chunk::side_to_move;
+  static float GetResult(const Chunk& chunk) { return chunk.result; }
+};
+
+struct V5Format {
+  using Chunk = V5TrainingData;
+  static constexpr uint32_t kVersion = 5;
+  // INPUT_CLASSICAL_112_PLANE, the only encoding EncodePositionForNN produces.
+  static constexpr uint32_t kInputFormat = 1;
+  static constexpr auto kSideToMove = &Chunk::side_to_move_or_enpassant;
+  static float GetResult(const Chunk& chunk) { return chunk.result; }
+};
+
+struct V6Format {
+  using Chunk = V6TrainingData;
+  static constexpr uint32_t kVersion = 6;
+  static constexpr uint32_t kInputFormat = 1;
+  static constexpr auto kSideToMove = &Chunk::side_to_move_or_enpassant;
+  static float GetResult(const Chunk& chunk) { return chunk.result_q; }
+};
+
+#endif  // TRAININGDATA_TOOL_TRAININGDATAFORMAT_H
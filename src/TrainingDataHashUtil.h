@@ -0,0 +1,49 @@
+#ifndef TRAININGDATA_TOOL_TRAININGDATAHASHUTIL_H
+#define TRAININGDATA_TOOL_TRAININGDATAHASHUTIL_H
+
+#include <boost/functional/hash.hpp>
+#include <unordered_map>
+
+#include "TrainingDataFormat.h"
+
+#define ARR_LENGTH(a) (sizeof(a) / sizeof(a[0]))
+
+// Hash and equality over the position part of a chunk (planes, castling, side
+// to move, rule50), so chunks of the same position compare equal regardless of
+// their probabilities or evaluation.
+template <typename Format>
+struct TrainingDataHash {
+  size_t operator()(const typename Format::Chunk& k) const {
+    size_t hash = boost::hash_range(k.planes, k.planes + ARR_LENGTH(k.planes));
+    boost::hash_combine(hash, k.castling_us_ooo);
+    boost::hash_combine(hash, k.castling_us_oo);
+    boost::hash_combine(hash, k.castling_them_ooo);
+    boost::hash_combine(hash, k.castling_them_oo);
+    boost::hash_combine(hash, k.*Format::kSideToMove);
+    boost::hash_combine(hash, k.rule50_count);
+    return hash;
+  }
+};
+
+template <typename Format>
+struct TrainingDataEqual {
+  bool operator()(const typename Format::Chunk& lhs,
+                  const typename Format::Chunk& rhs) const {
+    return std::equal(lhs.planes, lhs.planes + ARR_LENGTH(lhs.planes),
+                      rhs.planes) &&
+           lhs.castling_us_ooo == rhs.castling_us_ooo &&
+           lhs.castling_us_oo == rhs.castling_us_oo &&
+           lhs.castling_them_ooo == rhs.castling_them_ooo &&
+           lhs.castling_them_oo == rhs.castling_them_oo &&
+           lhs.*Format::kSideToMove == rhs.*Format::kSideToMove &&
+           lhs.rule50_count == rhs.rule50_count;
+  }
+};
+
+// Map from a unique position to the number of chunks merged into it.
+template <typename Format>
+using ChunkCountMap =
+    std::unordered_map<typename Format::Chunk, size_t,
+                       TrainingDataHash<Format>, TrainingDataEqual<Format>>;
+
+#endif  // TRAININGDATA_TOOL_TRAININGDATAHASHUTIL_H
@@ -1,38 +1,71 @@
 #include <algorithm>
 #include <filesystem>
 #include <iostream>
+#include <stdexcept>
 
 #include "TrainingDataReader.h"
 
-TrainingDataReader::TrainingDataReader(const std::string& in_directory)
-    : in_files(), file(nullptr) {
+template <typename Format>
+TrainingDataReader<Format>::TrainingDataReader(const std::string& in_directory)
+    : in_files(),
+      file(nullptr),
+      check_version(false),
+      next_block(0),
+      block_pos(0) {
   for (auto& p : std::filesystem::directory_iterator(in_directory)) {
+    // Shard indexes written by ShardSink sit next to the data.
+    if (p.path().extension() == ".idx") continue;
     in_files.push_back(p.path().string());
   }
   std::sort(in_files.begin(), in_files.end());
   in_files_it = in_files.begin();
 }
 
-TrainingDataReader::~TrainingDataReader() {
+template <typename Format>
+TrainingDataReader<Format>::~TrainingDataReader() {
   if (nullptr != file) {
     gzclose(file);
   }
 }
 
-std::optional<lczero::V4TrainingData> TrainingDataReader::ReadChunk() {
-  const size_t length = sizeof(lczero::V4TrainingData);
-  lczero::V4TrainingData buffer{};
-  int bytes_read;
-  do {
+template <typename Format>
+std::optional<typename Format::Chunk> TrainingDataReader<Format>::ReadChunk() {
+  const size_t length = sizeof(Chunk);
+  Chunk buffer{};
+  while (true) {
+    if (nullptr != indexed_file) {
+      if (block_pos < block.size()) {
+        return block[block_pos++];
+      }
+      if (next_block < indexed_file->NumBlocks()) {
+        block = indexed_file->ReadBlock(next_block++);
+        block_pos = 0;
+        continue;
+      }
+      indexed_file.reset();
+    }
     gzFile currentFile = getCurrentFile();
+    if (nullptr != indexed_file) continue;
     if (nullptr == currentFile) {
       return std::nullopt;
     }
-    bytes_read = gzread(currentFile, &buffer, length);
-  } while (length != bytes_read);
-  return std::optional<lczero::V4TrainingData>{buffer};
+    if (gzread(currentFile, &buffer, length) == static_cast<int>(length)) {
+      if (check_version) {
+        // A record of another version would make every chunk misaligned.
+        check_version = false;
+        if (buffer.version != Format::kVersion) {
+          throw std::runtime_error(
+              file_name + " holds V" + std::to_string(buffer.version) +
+              " training data, expected V" + std::to_string(Format::kVersion));
+        }
+      }
+      return std::optional<Chunk>{buffer};
+    }
+  }
 }
-gzFile TrainingDataReader::getCurrentFile() {
+
+template <typename Format>
+gzFile TrainingDataReader<Format>::getCurrentFile() {
   if (nullptr != file && gzeof(file)) {
     gzclose(file);
     file = nullptr;
@@ -41,8 +74,24 @@ gzFile TrainingDataReader::getCurrentFile() {
     if (in_files_it == in_files.end()) {
       return nullptr;
     }
+    if (std::filesystem::path(*in_files_it).extension() ==
+        kIndexedFileExtension) {
+      indexed_file =
+          std::make_unique<IndexedTrainingDataReader<Format>>(*in_files_it);
+      next_block = 0;
+      block.clear();
+      block_pos = 0;
+      in_files_it++;
+      return nullptr;
+    }
     file = gzopen(in_files_it->c_str(), "r");
+    file_name = *in_files_it;
+    check_version = true;
     in_files_it++;
   }
   return file;
 }
+
+template class TrainingDataReader<V4Format>;
+template class TrainingDataReader<V5Format>;
+template class TrainingDataReader<V6Format>;
@@ -1,23 +1,41 @@
 #ifndef TRAININGDATA_TOOL_TRAININGDATAREADER_H
 #define TRAININGDATA_TOOL_TRAININGDATAREADER_H
 
+#include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 #include <zlib.h>
 
-#include "neural/writer.h"
+#include "IndexedTrainingData.h"
+#include "TrainingDataFormat.h"
 
+// Sequentially reads every chunk of every file in a directory. Gzipped, raw
+// and sharded files are read through zlib; .tdi files block by block. The
+// first record of every file must carry Format::kVersion, otherwise ReadChunk
+// throws std::runtime_error. Instantiated for V4Format, V5Format and V6Format.
+template <typename Format>
 class TrainingDataReader {
 public:
+  using Chunk = typename Format::Chunk;
+
   TrainingDataReader(const std::string &in_directory);
   virtual ~TrainingDataReader();
-  std::optional<lczero::V4TrainingData> ReadChunk();
+  std::optional<Chunk> ReadChunk();
 
 private:
   gzFile getCurrentFile();
   std::vector<std::string> in_files;
   std::vector<std::string>::iterator in_files_it;
   gzFile file;
+  std::string file_name;
+  // Set when a file is opened, until its first record has been checked.
+  bool check_version;
+
+  std::unique_ptr<IndexedTrainingDataReader<Format>> indexed_file;
+  size_t next_block;
+  std::vector<Chunk> block;
+  size_t block_pos;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,209 @@
+#include "TrainingDataSink.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+
+const size_t kBufferSize = 1 << 20;
+
+std::string member_name(size_t file_id) {
+  std::ostringstream oss;
+  oss << "game_" << std::setfill('0') << std::setw(6) << file_id;
+  return oss.str();
+}
+
+}  // namespace
+
+DirectorySink::DirectorySink(std::string dir_prefix,
+                             size_t max_files_per_directory, bool compress)
+    : dir_prefix(std::move(dir_prefix)),
+      max_files_per_directory(max_files_per_directory),
+      compress(compress),
+      file(nullptr) {}
+
+DirectorySink::~DirectorySink() {
+  if (nullptr != file) {
+    gzclose(file);
+  }
+}
+
+void DirectorySink::BeginFile(size_t file_id) {
+  std::string directory =
+      dir_prefix + std::to_string(file_id / max_files_per_directory);
+  std::filesystem::create_directories(directory);
+  filename = directory + "/" + member_name(file_id) + (compress ? ".gz" : "");
+  // "T" makes zlib write the bytes through without compressing them.
+  file = gzopen(filename.c_str(), compress ? "wb" : "wbT");
+  if (nullptr == file) {
+    throw std::runtime_error("Cannot create file " + filename);
+  }
+}
+
+void DirectorySink::Write(const void* data, size_t length, const ChunkInfo&) {
+  if (gzwrite(file, data, static_cast<unsigned>(length)) !=
+      static_cast<int>(length)) {
+    throw std::runtime_error("Unable to write into " + filename);
+  }
+}
+
+void DirectorySink::EndFile() {
+  gzclose(file);
+  file = nullptr;
+}
+
+StreamSink::StreamSink(const std::string& path) : path(path) {
+  if (path == "-") {
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    file = stdout;
+  } else {
+    file = std::fopen(path.c_str(), "wb");
+    if (nullptr == file) {
+      throw std::runtime_error("Cannot open " + path);
+    }
+  }
+  std::setvbuf(file, nullptr, _IOFBF, kBufferSize);
+}
+
+StreamSink::~StreamSink() {
+  if (file == stdout) {
+    std::fflush(file);
+  } else {
+    std::fclose(file);
+  }
+}
+
+void StreamSink::Write(const void* data, size_t length, const ChunkInfo&) {
+  if (std::fwrite(data, 1, length, file) != length) {
+    throw std::runtime_error("Unable to write into " + path);
+  }
+}
+
+void StreamSink::Flush() { std::fflush(file); }
+
+ShardSink::ShardSink(std::string directory, size_t files_per_shard)
+    : directory(std::move(directory)),
+      files_per_shard(files_per_shard),
+      shards_written(0),
+      members_in_shard(0),
+      shard(nullptr),
+      index(nullptr),
+      shard_bytes(0),
+      member_id(0),
+      member_offset(0),
+      member_raw_bytes(0),
+      stream(),
+      out_buffer(kBufferSize) {}
+
+ShardSink::~ShardSink() {
+  // Errors cannot be thrown from here, so they are only reported.
+  try {
+    CloseShard();
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+  }
+}
+
+void ShardSink::BeginFile(size_t file_id) {
+  if (nullptr == shard) {
+    OpenShard();
+  }
+  member_id = file_id;
+  member_offset = shard_bytes;
+  member_raw_bytes = 0;
+  stream = z_stream();
+  // windowBits 15 + 16 selects a gzip header instead of a zlib one.
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("Cannot initialize deflate for " + shard_name);
+  }
+}
+
+void ShardSink::Write(const void* data, size_t length, const ChunkInfo&) {
+  stream.next_in = static_cast<Bytef*>(const_cast<void*>(data));
+  stream.avail_in = static_cast<uInt>(length);
+  member_raw_bytes += length;
+  Deflate(Z_NO_FLUSH);
+}
+
+void ShardSink::EndFile() {
+  stream.next_in = nullptr;
+  stream.avail_in = 0;
+  Deflate(Z_FINISH);
+  deflateEnd(&stream);
+  if (std::fprintf(index, "%s %llu %llu %llu\n",
+                   member_name(member_id).c_str(),
+                   static_cast<unsigned long long>(member_offset),
+                   static_cast<unsigned long long>(shard_bytes - member_offset),
+                   static_cast<unsigned long long>(member_raw_bytes)) < 0) {
+    throw std::runtime_error("Unable to write index of " + shard_name);
+  }
+  if (++members_in_shard >= files_per_shard) {
+    CloseShard();
+  }
+}
+
+void ShardSink::Flush() {
+  if (nullptr != shard &&
+      (std::fflush(shard) != 0 || std::fflush(index) != 0)) {
+    throw std::runtime_error("Unable to write into " + shard_name);
+  }
+}
+
+void ShardSink::OpenShard() {
+  std::filesystem::create_directories(directory);
+  std::ostringstream oss;
+  oss << directory << "/shard_" << std::setfill('0') << std::setw(6)
+      << shards_written;
+  shard_name = oss.str() + ".gz";
+  std::string index_name = oss.str() + ".idx";
+  shard = std::fopen(shard_name.c_str(), "wb");
+  index = std::fopen(index_name.c_str(), "w");
+  if (nullptr == shard || nullptr == index) {
+    if (nullptr != shard) std::fclose(shard);
+    if (nullptr != index) std::fclose(index);
+    shard = nullptr;
+    index = nullptr;
+    throw std::runtime_error("Cannot create shard " + shard_name);
+  }
+  std::setvbuf(shard, nullptr, _IOFBF, kBufferSize);
+  shard_bytes = 0;
+  members_in_shard = 0;
+}
+
+void ShardSink::CloseShard() {
+  if (nullptr == shard) return;
+  bool ok = std::fclose(shard) == 0;
+  ok = std::fclose(index) == 0 && ok;
+  shard = nullptr;
+  index = nullptr;
+  shards_written++;
+  if (!ok) {
+    throw std::runtime_error("Unable to write into " + shard_name);
+  }
+}
+
+void ShardSink::Deflate(int flush) {
+  int ret;
+  do {
+    stream.next_out = out_buffer.data();
+    stream.avail_out = static_cast<uInt>(out_buffer.size());
+    ret = deflate(&stream, flush);
+    size_t produced = out_buffer.size() - stream.avail_out;
+    if (std::fwrite(out_buffer.data(), 1, produced, shard) != produced) {
+      throw std::runtime_error("Unable to write into " + shard_name);
+    }
+    shard_bytes += produced;
+  } while (stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+}
@@ -0,0 +1,115 @@
+#ifndef TRAININGDATA_TOOL_TRAININGDATASINK_H
+#define TRAININGDATA_TOOL_TRAININGDATASINK_H
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Facts about a chunk that a sink may record without decoding it.
+struct ChunkInfo {
+  static constexpr uint16_t kUnknownPly = 0xFFFF;
+
+  // Game result from the side to move's perspective, in [-1, 1].
+  float result;
+  // Ply of the position within its game, when the producer knows it.
+  uint16_t ply;
+};
+
+// Destination for the bytes a TrainingDataWriter produces. The writer groups
+// chunks into numbered logical files; each sink decides what a file maps to.
+class TrainingDataSink {
+ public:
+  virtual ~TrainingDataSink() = default;
+
+  virtual void BeginFile(size_t file_id) = 0;
+  // Called once per chunk.
+  virtual void Write(const void* data, size_t length,
+                     const ChunkInfo& info) = 0;
+  virtual void EndFile() = 0;
+  // Makes everything written so far complete and readable on disk. Called by
+  // TrainingDataWriter::Finalize; writing may continue afterwards.
+  virtual void Flush() {}
+};
+
+// One file per logical file, in <dir_prefix>N/game_NNNNNN[.gz] with a new
+// directory every max_files_per_directory files. This is the layout lc0
+// selfplay produces. Uncompressed files are written with zlib's transparent
+// mode, so they are still readable through gzread.
+class DirectorySink : public TrainingDataSink {
+ public:
+  DirectorySink(std::string dir_prefix, size_t max_files_per_directory,
+                bool compress = true);
+  ~DirectorySink() override;
+
+  void BeginFile(size_t file_id) override;
+  void Write(const void* data, size_t length, const ChunkInfo&) override;
+  void EndFile() override;
+
+ private:
+  const std::string dir_prefix;
+  const size_t max_files_per_directory;
+  const bool compress;
+  std::string filename;
+  gzFile file;
+};
+
+// Raw, uncompressed chunks back to back on a single stream: stdout for "-",
+// otherwise the named file or FIFO. File boundaries are not marked.
+class StreamSink : public TrainingDataSink {
+ public:
+  explicit StreamSink(const std::string& path);
+  ~StreamSink() override;
+
+  void BeginFile(size_t) override {}
+  void Write(const void* data, size_t length, const ChunkInfo&) override;
+  void EndFile() override {}
+  void Flush() override;
+
+ private:
+  std::string path;
+  FILE* file;
+};
+
+// Packs files_per_shard logical files into each <directory>/shard_NNNNNN.gz as
+// consecutive gzip members. A shard is itself a valid gzip stream, so gzread
+// and zcat read it whole. Next to it, shard_NNNNNN.idx has one line
+// per member:
+//
+//   game_NNNNNN <offset> <compressed bytes> <uncompressed bytes>
+//
+// so a single member can be located and inflated on its own.
+class ShardSink : public TrainingDataSink {
+ public:
+  ShardSink(std::string directory, size_t files_per_shard);
+  ~ShardSink() override;
+
+  void BeginFile(size_t file_id) override;
+  void Write(const void* data, size_t length, const ChunkInfo&) override;
+  void EndFile() override;
+  void Flush() override;
+
+ private:
+  void OpenShard();
+  void CloseShard();
+  void Deflate(int flush);
+
+  const std::string directory;
+  const size_t files_per_shard;
+  size_t shards_written;
+  size_t members_in_shard;
+  std::string shard_name;
+  FILE* shard;
+  FILE* index;
+  uint64_t shard_bytes;
+
+  size_t member_id;
+  uint64_t member_offset;
+  uint64_t member_raw_bytes;
+  z_stream stream;
+  std::vector<unsigned char> out_buffer;
+};
+
+#endif  // TRAININGDATA_TOOL_TRAININGDATASINK_H
@@ -0,0 +1,177 @@
+#include "TrainingDataStream.h"
+
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "chess/position.h"
+#include "pgn.h"
+#include "polyglot_lib.h"
+
+#include "TrainingDataReader.h"
+
+void trainingdata_init() {
+  static std::once_flag flag;
+  std::call_once(flag, [] {
+    lczero::InitializeMagicBitboards();
+    polyglot_init();
+  });
+}
+
+template <typename Format>
+TrainingDataStream<Format>::TrainingDataStream(StreamInput input,
+                                               std::vector<std::string> paths,
+                                               StreamOptions options)
+    : paths(std::move(paths)),
+      options(options),
+      // Two arenas per worker: one being encoded, one parsed ahead.
+      free_arenas(2 * options.num_workers),
+      games(2 * options.num_workers),
+      batches(options.max_queued_batches) {
+  if (options.num_workers < 1) {
+    throw std::invalid_argument("StreamOptions::num_workers must be >= 1");
+  }
+  if (options.chunks_per_batch < 1) {
+    throw std::invalid_argument("StreamOptions::chunks_per_batch must be >= 1");
+  }
+  if (options.max_queued_batches < 1) {
+    throw std::invalid_argument(
+        "StreamOptions::max_queued_batches must be >= 1");
+  }
+  trainingdata_init();
+  for (size_t i = 0; i < 2 * options.num_workers; ++i) {
+    free_arenas.Push(std::make_unique<GameArena>());
+  }
+
+  running_threads = options.num_workers + 1;
+  if (input == StreamInput::PGN_FILES) {
+    threads.emplace_back(&TrainingDataStream::RunThread, this,
+                         &TrainingDataStream::ReadPgnFiles);
+  } else {
+    threads.emplace_back(&TrainingDataStream::RunThread, this,
+                         &TrainingDataStream::ReadTrainingDirs);
+  }
+  for (size_t i = 0; i < options.num_workers; ++i) {
+    threads.emplace_back(&TrainingDataStream::RunThread, this,
+                         &TrainingDataStream::EncodeGames);
+  }
+}
+
+template <typename Format>
+TrainingDataStream<Format>::~TrainingDataStream() {
+  free_arenas.Close();
+  games.Close();
+  batches.Close();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+template <typename Format>
+std::optional<typename TrainingDataStream<Format>::Batch>
+TrainingDataStream<Format>::NextBatch() {
+  auto batch = batches.Pop();
+  if (!batch) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (error) std::rethrow_exception(error);
+  }
+  return batch;
+}
+
+template <typename Format>
+void TrainingDataStream<Format>::ForEachBatch(
+    const std::function<void(Batch&)>& callback) {
+  while (auto batch = NextBatch()) {
+    callback(*batch);
+  }
+}
+
+template <typename Format>
+void TrainingDataStream<Format>::ReadPgnFiles() {
+  bool stopped = false;
+  for (auto path = paths.begin(); path != paths.end() && !stopped; ++path) {
+    if (!std::filesystem::is_regular_file(*path)) continue;
+    pgn_t pgn[1];
+    pgn_open(pgn, path->c_str());
+    while (options.max_games < 0 || games_read < options.max_games) {
+      auto arena = free_arenas.Pop();
+      if (!arena) {
+        stopped = true;
+        break;
+      }
+      if (!pgn_next_game(pgn)) {
+        free_arenas.Push(std::move(*arena));
+        break;
+      }
+      PGNGame game(pgn, **arena);
+      game.index = options.first_game_index + games_read;
+      if (!games.Push(ParsedGame{std::move(*arena), game})) {
+        stopped = true;
+        break;
+      }
+      games_read++;
+    }
+    pgn_close(pgn);
+  }
+  games.Close();
+}
+
+template <typename Format>
+void TrainingDataStream<Format>::ReadTrainingDirs() {
+  games.Close();
+  Batch batch;
+  for (const auto& path : paths) {
+    if (!std::filesystem::is_directory(path)) continue;
+    TrainingDataReader<Format> reader(path);
+    while (auto chunk = reader.ReadChunk()) {
+      batch.chunks.push_back(*chunk);
+      if (batch.chunks.size() >= options.chunks_per_batch) {
+        if (!batches.Push(std::move(batch))) return;
+        batch = Batch();
+      }
+    }
+  }
+  if (!batch.chunks.empty()) batches.Push(std::move(batch));
+}
+
+template <typename Format>
+void TrainingDataStream<Format>::EncodeGames() {
+  Batch batch;
+  while (auto parsed = games.Pop()) {
+    auto chunks = parsed->game.template getChunks<Format>(
+        options.game_options, &batch.plies);
+    free_arenas.Push(std::move(parsed->arena));
+    batch.chunks.insert(batch.chunks.end(), chunks.begin(), chunks.end());
+    if (batch.chunks.size() >= options.chunks_per_batch) {
+      if (!batches.Push(std::move(batch))) return;
+      batch = Batch();
+    }
+  }
+  if (!batch.chunks.empty()) batches.Push(std::move(batch));
+}
+
+template <typename Format>
+void TrainingDataStream<Format>::RunThread(void (TrainingDataStream::*body)()) {
+  try {
+    (this->*body)();
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) error = std::current_exception();
+    }
+    // Stop every other thread; the consumer sees the error once it has taken
+    // the batches already queued.
+    free_arenas.Close();
+    games.Close();
+    batches.Close();
+  }
+  // The last thread out tells the consumer there is nothing more to come.
+  if (--running_threads == 0) {
+    batches.Close();
+  }
+}
+
+template class TrainingDataStream<V4Format>;
+template class TrainingDataStream<V5Format>;
+template class TrainingDataStream<V6Format>;
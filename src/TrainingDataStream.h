@@ -0,0 +1,117 @@
+#ifndef TRAININGDATA_TOOL_TRAININGDATASTREAM_H
+#define TRAININGDATA_TOOL_TRAININGDATASTREAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "GameArena.h"
+#include "PGNGame.h"
+#include "TrainingDataFormat.h"
+
+// Initializes the lc0 and polyglot tables. Safe to call more than once; the
+// stream calls it itself, so only users of the lower level classes need it.
+void trainingdata_init();
+
+enum class StreamInput {
+  PGN_FILES,       // PGN games, encoded on the fly.
+  TRAINING_DIRS,   // Directories of already written training data files.
+};
+
+// The stream constructor throws std::invalid_argument if num_workers,
+// chunks_per_batch or max_queued_batches is 0.
+struct StreamOptions {
+  Options game_options;
+  size_t chunks_per_batch = 4096;
+  size_t num_workers = 1;
+  // Batches that may wait for the consumer before the workers block.
+  size_t max_queued_batches = 16;
+  // Stop after this many games, -1 for no limit. PGN input only.
+  int64_t max_games = -1;
+  // Index given to the first game read, the sampling key of PGNGame. Callers
+  // running several streams over one data set should carry it across them so
+  // that every game gets a distinct key.
+  int64_t first_game_index = 0;
+};
+
+template <typename Format>
+struct TrainingDataBatch {
+  std::vector<typename Format::Chunk> chunks;
+  // Game ply of each chunk. Empty when the input does not record it.
+  std::vector<uint16_t> plies;
+};
+
+// In-process source of training chunks, for feeding a trainer without going
+// through gzipped files on disk.
+//
+// One thread reads the inputs in order. For PGN input it parses games into a
+// pool of GameArenas and num_workers threads encode them; training directories
+// are read and batched directly. A batch is emitted once it holds at least
+// chunks_per_batch chunks; games are never split across batches, so it may
+// hold a few more. With a single worker games come out in input order; with
+// more, they are interleaved in completion order. All queues are bounded, so a
+// slow consumer throttles the workers instead of growing memory.
+//
+// Instantiated for V4Format, V5Format and V6Format.
+template <typename Format>
+class TrainingDataStream {
+ public:
+  using Chunk = typename Format::Chunk;
+  using Batch = TrainingDataBatch<Format>;
+
+  TrainingDataStream(StreamInput input, std::vector<std::string> paths,
+                     StreamOptions options);
+  // Stops the threads without draining; unconsumed batches are dropped.
+  ~TrainingDataStream();
+
+  TrainingDataStream(const TrainingDataStream&) = delete;
+  TrainingDataStream& operator=(const TrainingDataStream&) = delete;
+
+  // Blocks until a batch is ready. Returns std::nullopt once every input is
+  // exhausted. If a stream thread failed, the batches queued before the
+  // failure are still returned, then its exception is rethrown here.
+  std::optional<Batch> NextBatch();
+
+  // Pulls batches until the input is exhausted, passing each to callback.
+  void ForEachBatch(const std::function<void(Batch&)>& callback);
+
+  // Games handed to the workers so far.
+  int64_t GamesRead() const { return games_read; }
+
+ private:
+  struct ParsedGame {
+    std::unique_ptr<GameArena> arena;
+    PGNGame game;
+  };
+
+  // Runs a thread body, turning an exception into a stream failure instead of
+  // letting it reach std::terminate.
+  void RunThread(void (TrainingDataStream::*body)());
+  void ReadPgnFiles();
+  void ReadTrainingDirs();
+  void EncodeGames();
+
+  const std::vector<std::string> paths;
+  const StreamOptions options;
+
+  BoundedQueue<std::unique_ptr<GameArena>> free_arenas;
+  BoundedQueue<ParsedGame> games;
+  BoundedQueue<Batch> batches;
+
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  std::atomic<int64_t> games_read{0};
+  std::atomic<size_t> running_threads{0};
+  std::vector<std::thread> threads;
+};
+
+#endif  // TRAININGDATA_TOOL_TRAININGDATASTREAM_H
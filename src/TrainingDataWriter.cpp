@@ -2,42 +2,61 @@
 
 #include <utility>
 
-TrainingDataWriter::TrainingDataWriter(size_t max_files_per_directory,
-                                       size_t chunks_per_file,
-                                       std::string dir_prefix)
-    : files_written(0),
-      max_files_per_directory(max_files_per_directory),
-      chunks_per_file(chunks_per_file),
-      dir_prefix(std::move(dir_prefix)){};
-
-void TrainingDataWriter::EnqueueChunks(
-    const std::vector<lczero::V4TrainingData> &chunks) {
-  for (auto &chunk : chunks) {
-    chunks_queue.push(chunk);
+template <typename Format>
+TrainingDataWriter<Format>::TrainingDataWriter(size_t max_files_per_directory,
+                                               size_t chunks_per_file,
+                                               std::string dir_prefix)
+    : TrainingDataWriter(std::make_unique<DirectorySink>(
+                             std::move(dir_prefix), max_files_per_directory),
+                         chunks_per_file){};
+
+template <typename Format>
+TrainingDataWriter<Format>::TrainingDataWriter(
+    std::unique_ptr<TrainingDataSink> sink, size_t chunks_per_file)
+    : sink(std::move(sink)),
+      files_written(0),
+      chunks_per_file(chunks_per_file){};
+
+template <typename Format>
+void TrainingDataWriter<Format>::EnqueueChunks(
+    const std::vector<Chunk> &chunks, const std::vector<uint16_t> &plies) {
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    chunks_queue.push(
+        {chunks[i], plies.empty() ? ChunkInfo::kUnknownPly : plies[i]});
   }
   WriteQueuedChunks(chunks_per_file);
 }
 
-void TrainingDataWriter::EnqueueChunks(
-    const std::unordered_map<lczero::V4TrainingData, size_t> &chunks) {
-  for (auto chunk : chunks) {
-    chunks_queue.push(chunk.first);
+template <typename Format>
+void TrainingDataWriter<Format>::EnqueueChunks(
+    const ChunkCountMap<Format> &chunks) {
+  for (auto &chunk : chunks) {
+    chunks_queue.push({chunk.first, ChunkInfo::kUnknownPly});
     WriteQueuedChunks(chunks_per_file);
   }
 }
 
-void TrainingDataWriter::WriteQueuedChunks(size_t min_chunks) {
+template <typename Format>
+void TrainingDataWriter<Format>::WriteQueuedChunks(size_t min_chunks) {
   while (chunks_queue.size() > min_chunks) {
-    lczero::TrainingDataWriter writer(
-        files_written,
-        dir_prefix + std::to_string(files_written / max_files_per_directory));
+    sink->BeginFile(files_written);
     for (size_t i = 0; i < chunks_per_file && !chunks_queue.empty(); ++i) {
-      writer.WriteChunk(chunks_queue.front());
+      const QueuedChunk &queued = chunks_queue.front();
+      sink->Write(&queued.chunk, sizeof(Chunk),
+                  {Format::GetResult(queued.chunk), queued.ply});
       chunks_queue.pop();
     }
-    writer.Finalize();
+    sink->EndFile();
     files_written++;
   }
 }
 
-void TrainingDataWriter::Finalize() { WriteQueuedChunks(0); }
+template <typename Format>
+void TrainingDataWriter<Format>::Finalize() {
+  WriteQueuedChunks(0);
+  sink->Flush();
+}
+
+template class TrainingDataWriter<V4Format>;
+template class TrainingDataWriter<V5Format>;
+template class TrainingDataWriter<V6Format>;
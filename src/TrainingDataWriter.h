@@ -3,35 +3,49 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <queue>
-#include <unordered_map>
-
-#include "neural/encoder.h"
-#include "neural/network.h"
-#include "neural/writer.h"
-
-#include "V4TrainingDataHashUtil.h"
-
+#include <string>
+#include <vector>
+
+#include "TrainingDataFormat.h"
+#include "TrainingDataHashUtil.h"
+#include "TrainingDataSink.h"
+
+// Buffers chunks and hands them to a sink chunks_per_file at a time. By
+// default the sink is a DirectorySink writing gzipped files and starting a new
+// directory every max_files_per_directory files. Instantiated for V4Format,
+// V5Format and V6Format.
+template <typename Format>
 class TrainingDataWriter {
  public:
+  using Chunk = typename Format::Chunk;
+
   TrainingDataWriter(size_t max_files_per_directory, size_t chunks_per_file,
                      std::string dir_prefix = "supervised-");
+  TrainingDataWriter(std::unique_ptr<TrainingDataSink> sink,
+                     size_t chunks_per_file);
 
-  void EnqueueChunks(const std::vector<lczero::V4TrainingData>& chunks);
-  void EnqueueChunks(
-      const std::unordered_map<lczero::V4TrainingData, size_t>& chunks);
+  // plies, if not empty, holds the game ply of each chunk.
+  void EnqueueChunks(const std::vector<Chunk>& chunks,
+                     const std::vector<uint16_t>& plies = {});
+  void EnqueueChunks(const ChunkCountMap<Format>& chunks);
 
   void Finalize();
 
  private:
+  struct QueuedChunk {
+    Chunk chunk;
+    uint16_t ply;
+  };
+
   void WriteQueuedChunks(size_t min_chunks);
 
-  std::queue<lczero::V4TrainingData> chunks_queue;
+  std::unique_ptr<TrainingDataSink> sink;
+  std::queue<QueuedChunk> chunks_queue;
   size_t files_written;
-  size_t max_files_per_directory;
   size_t chunks_per_file;
-  const std::string dir_prefix;
 };
 
 #endif
@@ -2,20 +2,46 @@
 #include "pgn.h"
 #include "polyglot_lib.h"
 
+#include <algorithm>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
+#include "IndexedTrainingData.h"
 #include "PGNGame.h"
 #include "TrainingDataDedup.h"
 #include "TrainingDataReader.h"
+#include "TrainingDataSink.h"
+#include "TrainingDataStream.h"
 #include "TrainingDataWriter.h"
 
 size_t max_files_per_directory = 10000;
 int64_t max_games_to_convert = 10000000;
 size_t chunks_per_file = 4096;
+size_t chunks_per_block = 256;
 size_t dedup_uniq_buffersize = 50000;
 float dedup_q_ratio = 1.0f;
+int training_data_format = 4;
+size_t num_threads = 1;
+std::string output_sink = "gz";
+std::string output_path = "-";
+
+// Options followed by a value. Any other argument not starting with '-' is an
+// input path.
+const std::set<std::string> options_with_value = {
+    "-files-per-dir",         "-max-games-to-convert",
+    "-chunks-per-file",       "-chunks-per-block",
+    "-dedup-uniq-buffersize", "-dedup-q-ratio",
+    "-threads",               "-sink",
+    "-output",                "-sample-seed",
+    "-sample-rate",           "-sample-opening-plies",
+    "-sample-opening-rate",   "-sample-target-per-game",
+    "-format",
+};
 
 inline bool file_exists(const std::string &name) {
   auto s = std::filesystem::status(name);
@@ -27,30 +53,116 @@ inline bool directory_exists(const std::string &name) {
   return std::filesystem::is_directory(s);
 }
 
-void convert_games(const std::string &pgn_file_name, Options options) {
-  int game_id = 0;
-  pgn_t pgn[1];
-  pgn_open(pgn, pgn_file_name.c_str());
-  TrainingDataWriter writer(max_files_per_directory, chunks_per_file);
-  while (pgn_next_game(pgn) && game_id < max_games_to_convert) {
-    PGNGame game(pgn);
-    writer.EnqueueChunks(game.getChunks(options));
-    game_id++;
-    if (game_id % 1000 == 0) {
-      std::cout << game_id << " games written." << std::endl;
-    }
+std::unique_ptr<TrainingDataSink> make_sink(const std::string &prefix) {
+  if (output_sink == "raw") {
+    return std::make_unique<DirectorySink>(prefix, max_files_per_directory,
+                                           false);
+  } else if (output_sink == "stream") {
+    return std::make_unique<StreamSink>(output_path);
+  } else if (output_sink == "shard") {
+    return std::make_unique<ShardSink>(prefix + "shards",
+                                       max_files_per_directory);
+  } else if (output_sink == "indexed") {
+    return std::make_unique<IndexedSink>(prefix + "indexed", chunks_per_block,
+                                         max_files_per_directory);
   }
+  return std::make_unique<DirectorySink>(prefix, max_files_per_directory);
+}
+
+// Games converted so far over all input files, so that sampling keys do not
+// repeat from one file to the next.
+int64_t games_converted = 0;
+
+template <typename Format>
+void convert_games(TrainingDataWriter<Format> &writer,
+                   const std::string &pgn_file_name, Options options) {
+  StreamOptions stream_options;
+  stream_options.first_game_index = games_converted;
+  stream_options.game_options = options;
+  stream_options.chunks_per_batch = chunks_per_file;
+  stream_options.num_workers = num_threads;
+  stream_options.max_games = max_games_to_convert;
+  TrainingDataStream<Format> stream(StreamInput::PGN_FILES, {pgn_file_name},
+                                    stream_options);
+  int64_t games_reported = 0;
+  stream.ForEachBatch([&](typename TrainingDataStream<Format>::Batch &batch) {
+    writer.EnqueueChunks(batch.chunks, batch.plies);
+    int64_t games_read = stream.GamesRead();
+    if (games_read / 1000 > games_reported / 1000) {
+      std::cout << games_read << " games written." << std::endl;
+      games_reported = games_read;
+    }
+  });
   writer.Finalize();
-  std::cout << "Finished writing " << game_id << " games." << std::endl;
-  pgn_close(pgn);
+  games_converted += stream.GamesRead();
+  std::cout << "Finished writing " << stream.GamesRead() << " games."
+            << std::endl;
+}
+
+template <typename Format>
+void run(const std::vector<std::string> &inputs, Options options,
+         bool deduplication_mode) {
+  TrainingDataWriter<Format> writer(
+      make_sink(deduplication_mode ? "deduped-" : "supervised-"),
+      chunks_per_file);
+  for (const auto &input : inputs) {
+    if (deduplication_mode) {
+      if (!directory_exists(input)) continue;
+      TrainingDataReader<Format> reader(input);
+      training_data_dedup(reader, writer, dedup_uniq_buffersize, dedup_q_ratio);
+    } else {
+      if (!file_exists(input)) continue;
+      if (options.verbose) {
+        std::cout << "Opening \'" << input << "\'" << std::endl;
+      }
+      convert_games<Format>(writer, input, options);
+    }
+  }
 }
 
 int main(int argc, char *argv[]) {
-  lczero::InitializeMagicBitboards();
-  polyglot_init();
+  // Resolve the output and collect the inputs first, skipping option values so
+  // that e.g. the -output file is never read back as a PGN.
+  std::vector<std::string> inputs;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string arg = argv[idx];
+    if (options_with_value.count(arg) > 0) {
+      if (idx + 1 >= argc) break;
+      std::string value = argv[++idx];
+      if (arg == "-sink") {
+        output_sink = value;
+      } else if (arg == "-output") {
+        output_path = value;
+        output_sink = "stream";
+      }
+    } else if (arg.empty() || arg[0] != '-') {
+      inputs.push_back(arg);
+    }
+  }
+  if (output_sink != "gz" && output_sink != "raw" && output_sink != "stream" &&
+      output_sink != "shard" && output_sink != "indexed") {
+    std::cerr << "Unknown sink '" << output_sink
+              << "', expected gz, raw, stream, shard or indexed" << std::endl;
+    return 1;
+  }
+  if (output_sink == "stream") {
+    inputs.erase(std::remove(inputs.begin(), inputs.end(), output_path),
+                 inputs.end());
+  }
+  // Training data may go to stdout, so keep it clean of progress messages.
+  if (output_sink == "stream" && output_path == "-") {
+    std::cout.rdbuf(std::cerr.rdbuf());
+  }
+
+  trainingdata_init();
   Options options;
   bool deduplication_mode = false;
-  for (size_t idx = 0; idx < argc; ++idx) {
+  for (int idx = 1; idx < argc; ++idx) {
+    bool has_value = options_with_value.count(argv[idx]) > 0;
+    if (has_value && idx + 1 >= argc) {
+      std::cerr << "Missing value for " << argv[idx] << std::endl;
+      return 1;
+    }
     if (0 == static_cast<std::string>("-v").compare(argv[idx])) {
       std::cout << "Verbose mode ON" << std::endl;
       options.verbose = true;
@@ -70,8 +182,12 @@ int main(int argc, char *argv[]) {
                 << std::endl;
     } else if (0 == static_cast<std::string>("-chunks-per-file")
                         .compare(argv[idx])) {
-      chunks_per_file = std::atoi(argv[idx + 1]);
+      chunks_per_file = std::max(1, std::atoi(argv[idx + 1]));
       std::cout << "Chunks per file set to: " << chunks_per_file << std::endl;
+    } else if (0 == static_cast<std::string>("-chunks-per-block")
+                        .compare(argv[idx])) {
+      chunks_per_block = std::max(1, std::atoi(argv[idx + 1]));
+      std::cout << "Chunks per block set to: " << chunks_per_block << std::endl;
     } else if (0 == static_cast<std::string>("-deduplication-mode")
                         .compare(argv[idx])) {
       deduplication_mode = true;
@@ -86,21 +202,68 @@ int main(int argc, char *argv[]) {
       dedup_q_ratio = std::stof(argv[idx + 1]);
       std::cout << "Deduplication Q ratio set to: " << dedup_q_ratio
                 << std::endl;
+    } else if (0 == static_cast<std::string>("-threads").compare(argv[idx])) {
+      num_threads = std::max(1, std::atoi(argv[idx + 1]));
+      std::cout << "Encoding threads set to: " << num_threads << std::endl;
+    } else if (0 == static_cast<std::string>("-sink").compare(argv[idx])) {
+      std::cout << "Output sink set to: " << argv[idx + 1] << std::endl;
+    } else if (0 == static_cast<std::string>("-output").compare(argv[idx])) {
+      std::cout << "Streaming output to: " << argv[idx + 1] << std::endl;
+    } else if (0 ==
+               static_cast<std::string>("-sample-seed").compare(argv[idx])) {
+      options.sampling.seed = std::stoull(argv[idx + 1]);
+      std::cout << "Sampling seed set to: " << options.sampling.seed
+                << std::endl;
+    } else if (0 ==
+               static_cast<std::string>("-sample-rate").compare(argv[idx])) {
+      options.sampling.keep_rate = std::stof(argv[idx + 1]);
+      std::cout << "Sampling keep rate set to: " << options.sampling.keep_rate
+                << std::endl;
+    } else if (0 == static_cast<std::string>("-sample-opening-plies")
+                        .compare(argv[idx])) {
+      options.sampling.opening_plies = std::atoi(argv[idx + 1]);
+      std::cout << "Sampling opening plies set to: "
+                << options.sampling.opening_plies << std::endl;
+    } else if (0 == static_cast<std::string>("-sample-opening-rate")
+                        .compare(argv[idx])) {
+      options.sampling.opening_keep_rate = std::stof(argv[idx + 1]);
+      std::cout << "Sampling opening keep rate set to: "
+                << options.sampling.opening_keep_rate << std::endl;
+    } else if (0 == static_cast<std::string>("-sample-target-per-game")
+                        .compare(argv[idx])) {
+      options.sampling.target_per_game = std::atoi(argv[idx + 1]);
+      std::cout << "Sampling target positions per game set to: "
+                << options.sampling.target_per_game << std::endl;
+    } else if (0 == static_cast<std::string>("-sample-by-position")
+                        .compare(argv[idx])) {
+      options.sampling.by_position = true;
+      std::cout << "Sampling keyed by position hash" << std::endl;
+    } else if (0 == static_cast<std::string>("-format").compare(argv[idx])) {
+      training_data_format = std::atoi(argv[idx + 1]);
+      std::cout << "Training data format set to: V" << training_data_format
+                << std::endl;
     }
+    if (has_value) ++idx;
   }
 
-  TrainingDataWriter writer(max_files_per_directory, chunks_per_file, "deduped-");
-  for (size_t idx = 1; idx < argc; ++idx) {
-    if (deduplication_mode) {
-      if (!directory_exists(argv[idx])) continue;
-      TrainingDataReader reader(argv[idx]);
-      training_data_dedup(reader, writer, dedup_uniq_buffersize, dedup_q_ratio);
-    } else {
-      if (!file_exists(argv[idx])) continue;
-      if (options.verbose) {
-        std::cout << "Opening \'" << argv[idx] << "\'" << std::endl;
-      }
-      convert_games(argv[idx], options);
+  try {
+    switch (training_data_format) {
+      case 4:
+        run<V4Format>(inputs, options, deduplication_mode);
+        break;
+      case 5:
+        run<V5Format>(inputs, options, deduplication_mode);
+        break;
+      case 6:
+        run<V6Format>(inputs, options, deduplication_mode);
+        break;
+      default:
+        std::cerr << "Unsupported training data format: "
+                  << training_data_format << std::endl;
+        return 1;
     }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
   }
 }
@@ -1,6 +1,7 @@
 #include "trainingdata.h"
 
 #include <cstring>
+#include <limits>
 
 uint64_t resever_bits_in_bytes(uint64_t v) {
   v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
@@ -9,13 +10,18 @@ uint64_t resever_bits_in_bytes(uint64_t v) {
   return v;
 }
 
-lczero::V4TrainingData get_v4_training_data(
+template <typename Format>
+typename Format::Chunk get_training_data(
         lczero::GameResult game_result, const lczero::PositionHistory& history,
-        lczero::Move played_move, lczero::MoveList legal_moves, float Q) {
-  lczero::V4TrainingData result;
+        lczero::Move played_move, lczero::MoveList legal_moves, float Q,
+        int plies_left) {
+  typename Format::Chunk result{};
 
   // Set version.
-  result.version = 4;
+  result.version = Format::kVersion;
+  if constexpr (Format::kVersion >= 5) {
+    result.input_format = Format::kInputFormat;
+  }
 
   // Illegal moves will have "-1" probability
   for (auto& probability : result.probabilities) {
@@ -50,17 +56,28 @@ lczero::V4TrainingData get_v4_training_data(
           position.CanCastle(lczero::Position::THEY_CAN_OO) ? 1 : 0;
 
   // Other params.
-  result.side_to_move = position.IsBlackToMove() ? 1 : 0;
-  result.move_count = 0;
+  result.*Format::kSideToMove = position.IsBlackToMove() ? 1 : 0;
+  if constexpr (Format::kVersion == 4) {
+    result.move_count = 0;
+  } else {
+    result.invariance_info = 0;
+  }
   result.rule50_count = position.GetNoCaptureNoPawnPly();
 
   // Game result.
+  int8_t z;
   if (game_result == lczero::GameResult::WHITE_WON) {
-    result.result = position.IsBlackToMove() ? -1 : 1;
+    z = position.IsBlackToMove() ? -1 : 1;
   } else if (game_result == lczero::GameResult::BLACK_WON) {
-    result.result = position.IsBlackToMove() ? 1 : -1;
+    z = position.IsBlackToMove() ? 1 : -1;
+  } else {
+    z = 0;
+  }
+  if constexpr (Format::kVersion >= 6) {
+    result.result_q = z;
+    result.result_d = z == 0 ? 1.0f : 0.0f;
   } else {
-    result.result = 0;
+    result.result = z;
   }
 
   // Q for Q+Z training
@@ -68,5 +85,33 @@ lczero::V4TrainingData get_v4_training_data(
   // We have no D information
   result.root_d = result.best_d = 0.0f;
 
+  if constexpr (Format::kVersion >= 5) {
+    // No search, so no moves-left head estimate; the real count is known.
+    result.root_m = result.best_m = 0.0f;
+    result.plies_left = static_cast<float>(plies_left);
+  }
+
+  if constexpr (Format::kVersion >= 6) {
+    result.played_q = result.root_q;
+    result.played_d = 0.0f;
+    result.played_m = 0.0f;
+    // NaN marks "no original value", as lc0 does when Q was not substituted.
+    result.orig_q = result.orig_d = result.orig_m =
+        std::numeric_limits<float>::quiet_NaN();
+    result.visits = 0;
+    result.played_idx = result.best_idx = played_move.as_nn_index();
+    result.policy_kld = 0.0f;
+  }
+
   return result;
 }
+
+template V4Format::Chunk get_training_data<V4Format>(
+        lczero::GameResult, const lczero::PositionHistory&, lczero::Move,
+        lczero::MoveList, float, int);
+template V5Format::Chunk get_training_data<V5Format>(
+        lczero::GameResult, const lczero::PositionHistory&, lczero::Move,
+        lczero::MoveList, float, int);
+template V6Format::Chunk get_training_data<V6Format>(
+        lczero::GameResult, const lczero::PositionHistory&, lczero::Move,
+        lczero::MoveList, float, int);
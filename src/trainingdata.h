@@ -5,8 +5,15 @@
 #include "neural/network.h"
 #include "neural/writer.h"
 
-lczero::V4TrainingData get_v4_training_data(
+#include "TrainingDataFormat.h"
+
+// Encodes one position. plies_left is the number of plies remaining in the
+// game including played_move; it is ignored by formats that do not store it.
+// Instantiated for V4Format, V5Format and V6Format.
+template <typename Format>
+typename Format::Chunk get_training_data(
         lczero::GameResult game_result, const lczero::PositionHistory& history,
-        lczero::Move played_move, lczero::MoveList legal_moves, float Q);
+        lczero::Move played_move, lczero::MoveList legal_moves, float Q,
+        int plies_left);
 
 #endif